@@ -10,6 +10,7 @@ static const char *TAG = "Button";
 
 static button_event_cb long_press_callback = []() {};
 static button_event_cb short_press_callback = []() {};
+static button_event_cb double_press_callback = []() {};
 
 void register_long_press_callback(button_event_cb cb)
 {
@@ -21,6 +22,11 @@ void register_short_press_callback(button_event_cb cb)
     short_press_callback = cb;
 }
 
+void register_double_press_callback(button_event_cb cb)
+{
+    double_press_callback = cb;
+}
+
 bool is_button_pressed()
 {
     return gpio_get_level(BUTTON_GPIO) == 0;
@@ -46,6 +52,8 @@ void button_init(void)
 void button_task(void *pvParameters)
 {
     const int check_interval_ms = 100;      // Интервал проверки состояния кнопки
+    TickType_t last_short_press = 0;
+    bool short_press_pending = false;       // Было короткое нажатие, ждем второе
 
     button_init();
 
@@ -83,7 +91,20 @@ void button_task(void *pvParameters)
             else if (is_short_press)
             {
                 is_short_press = false;
-                short_press_callback();
+
+                // Первое нажатие срабатывает сразу, второе в окне - только двойное
+                TickType_t now = xTaskGetTickCount();
+                if (short_press_pending && now - last_short_press < pdMS_TO_TICKS(DOUBLE_PRESS_TIMEOUT_MS))
+                {
+                    short_press_pending = false;
+                    double_press_callback();
+                }
+                else
+                {
+                    short_press_pending = true;
+                    last_short_press = now;
+                    short_press_callback();
+                }
             }
         }
 
@@ -3,10 +3,12 @@
 #define BUTTON_GPIO             GPIO_NUM_9
 #define LONG_PRESS_TIEMOUT_MS   3000
 #define SHORT_PRESS_TIEMOUT_MS  500
+#define DOUBLE_PRESS_TIMEOUT_MS 600     // Второе короткое нажатие в этом окне - двойное
 
 typedef void (*button_event_cb)(void);
 
 void button_task(void *pvParameters);
 bool is_button_pressed(void);
 void register_long_press_callback(button_event_cb cb);
-void register_short_press_callback(button_event_cb cb);
\ No newline at end of file
+void register_short_press_callback(button_event_cb cb);
+void register_double_press_callback(button_event_cb cb);
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "app_log.h"
+
+#define APP_LOG_MAGIC 0x41504C47 // "APLG"
+
+static const char *TAG = "AppLog";
+
+// Кольцевой буфер в RTC-памяти переживает глубокий сон и программный сброс
+typedef struct
+{
+    uint32_t magic;
+    uint16_t wake;
+    uint16_t head;
+    uint16_t count;
+    app_log_record_t records[APP_LOG_CAPACITY];
+} app_log_buffer_t;
+
+static RTC_NOINIT_ATTR app_log_buffer_t log_buffer;
+static portMUX_TYPE log_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if APP_LOG_TEXT_MODE
+static const char *const log_formats[] = {
+#define APP_LOG_FORMAT_ENTRY(name, fmt) fmt,
+    APP_LOG_MESSAGES(APP_LOG_FORMAT_ENTRY)
+#undef APP_LOG_FORMAT_ENTRY
+};
+#endif
+
+void app_log_init(void)
+{
+    if (log_buffer.magic != APP_LOG_MAGIC || log_buffer.head >= APP_LOG_CAPACITY || log_buffer.count > APP_LOG_CAPACITY)
+    {
+        memset(&log_buffer, 0, sizeof(log_buffer));
+        log_buffer.magic = APP_LOG_MAGIC;
+    }
+
+    log_buffer.wake++;
+}
+
+void app_log_write(app_log_id_t id, const int32_t *args, uint8_t argc)
+{
+    uint32_t timestamp_ms = esp_log_timestamp();
+
+    portENTER_CRITICAL(&log_lock);
+    app_log_record_t *record = &log_buffer.records[log_buffer.head];
+    record->timestamp_ms = timestamp_ms;
+    record->wake = log_buffer.wake;
+    record->id = (uint8_t)id;
+    record->argc = argc;
+    memset(record->args, 0, sizeof(record->args));
+    memcpy(record->args, args, argc * sizeof(int32_t));
+
+    log_buffer.head = (log_buffer.head + 1) % APP_LOG_CAPACITY;
+    if (log_buffer.count < APP_LOG_CAPACITY)
+    {
+        log_buffer.count++;
+    }
+    portEXIT_CRITICAL(&log_lock);
+
+#if APP_LOG_TEXT_MODE
+    char line[128];
+    snprintf(line, sizeof(line), log_formats[id], args[0], args[1], args[2], args[3]);
+    ESP_LOGI(TAG, "%s", line);
+#endif
+}
+
+// Выгрузка буфера в UART: каждая запись - строка "APPLOG <hex>", разбирается tools/app_log_decode.py.
+// Записи копируются по одной, чтобы не держать весь буфер на стеке. Если во время выгрузки
+// пишутся новые записи, самые старые из еще не выгруженных могут быть уже перезаписаны.
+void app_log_dump(void)
+{
+    portENTER_CRITICAL(&log_lock);
+    uint16_t count = log_buffer.count;
+    uint16_t index = (log_buffer.head + APP_LOG_CAPACITY - count) % APP_LOG_CAPACITY;
+    portEXIT_CRITICAL(&log_lock);
+
+    ESP_LOGI(TAG, "Dump %d records", count);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        app_log_record_t record;
+        portENTER_CRITICAL(&log_lock);
+        memcpy(&record, &log_buffer.records[index], sizeof(record));
+        portEXIT_CRITICAL(&log_lock);
+
+        const uint8_t *raw = (const uint8_t *)&record;
+
+        printf("APPLOG ");
+        for (size_t j = 0; j < sizeof(app_log_record_t); j++)
+        {
+            printf("%02x", raw[j]);
+        }
+        printf("\n");
+
+        index = (index + 1) % APP_LOG_CAPACITY;
+    }
+}
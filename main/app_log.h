@@ -0,0 +1,75 @@
+#ifndef APP_LOG_H
+#define APP_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// 0 - бинарный лог в RTC-память (по умолчанию), 1 - отладочная сборка с текстовым ESP_LOG
+#define APP_LOG_TEXT_MODE   0
+#define APP_LOG_MAX_ARGS    4
+#define APP_LOG_CAPACITY    64 // Количество записей в кольцевом буфере, ~6 пробуждений по ~10 записей
+
+// Каталог сообщений: ID записи = порядковый номер строки.
+// Аргументы - целые int32_t, поэтому в форматах только %ld / %lx.
+// Этот же список читает tools/app_log_decode.py, новые сообщения добавлять только в конец.
+#define APP_LOG_MESSAGES(X) \
+    X(WAKEUP_TIMER,         "Пробуждение по таймеру") \
+    X(WAKEUP_BUTTON,        "Пробуждение по кнопке") \
+    X(WAKEUP_RESET,         "Первый запуск / сброс") \
+    X(DEEP_SLEEP,           "Переход в глубокий сон...") \
+    X(TEMPERATURE,          "Температура: %ld (0.01 °C)") \
+    X(HUMIDITY,             "Влажность: %ld (0.01 %%)") \
+    X(PRESSURE,             "Давление: %ld (0.1 kPa)") \
+    X(BATTERY,              "Напряжение: %ld mV (%ld %%)") \
+    X(LONG_PRESS,           "Обнаружено долгое нажатие. Сброс сети ZigBee...") \
+    X(ZB_STACK_INIT,        "Initialize Zigbee stack") \
+    X(ZB_STEERING_START,    "Start network steering") \
+    X(ZB_REBOOTED,          "Device rebooted") \
+    X(ZB_START_FAILED,      "Signal 0x%lx failed with status: 0x%lx. Retrying %ld") \
+    X(ZB_JOINED,            "Joined network successfully (PAN ID: 0x%04lx, Channel: %ld, Short Address: 0x%04lx)") \
+    X(ZB_EXT_PAN_ID,        "Extended PAN ID: %08lx%08lx") \
+    X(ZB_STEERING_FAILED,   "Network steering was not successful (status: 0x%lx). Retrying...") \
+    X(ZB_LEAVE,             "Устройство отключено от сети") \
+    X(ZB_SIGNAL,            "ZDO signal: 0x%lx, status: 0x%lx") \
+    X(POLL_CHECK_IN,        "Poll Control check-in sent") \
+    X(POLL_FAST_POLL_START, "Fast poll started for %ld qs") \
+    X(POLL_FAST_POLL_STOP,  "Fast poll stopped") \
+    X(TX_POWER,             "TX power: %ld dBm (RSSI %ld dBm, LQI %ld)") \
+    X(STORE_LOADED,         "Store loaded: sector %ld, record %ld, seq %ld") \
+    X(STORE_FLUSH,          "Store flushed %ld records (sector %ld, record %ld)") \
+    X(STORE_ERROR,          "Store flash error: 0x%lx") \
+    X(POLL_INVALID_VALUE,   "Poll Control command 0x%lx rejected: invalid value %ld") \
+    X(POLL_INVALID_ATTR,    "Poll Control attribute 0x%lx write rejected: invalid value %ld")
+
+typedef enum
+{
+#define APP_LOG_ENUM_ENTRY(name, fmt) APP_LOG_##name,
+    APP_LOG_MESSAGES(APP_LOG_ENUM_ENTRY)
+#undef APP_LOG_ENUM_ENTRY
+    APP_LOG_ID_COUNT
+} app_log_id_t;
+
+// Запись в кольцевом буфере, формат разбирает tools/app_log_decode.py
+typedef struct
+{
+    uint32_t timestamp_ms;          // Время от пробуждения
+    uint16_t wake;                  // Номер пробуждения
+    uint8_t id;                     // app_log_id_t
+    uint8_t argc;
+    int32_t args[APP_LOG_MAX_ARGS];
+} app_log_record_t;
+
+void app_log_init(void);
+void app_log_write(app_log_id_t id, const int32_t *args, uint8_t argc);
+void app_log_dump(void);
+
+// Точка логирования: ID + сырые аргументы без форматирования
+template <typename... Args>
+inline void app_log(app_log_id_t id, Args... args)
+{
+    static_assert(sizeof...(Args) <= APP_LOG_MAX_ARGS, "Too many log arguments");
+    const int32_t argv[APP_LOG_MAX_ARGS + 1] = {static_cast<int32_t>(args)...};
+    app_log_write(id, argv, sizeof...(Args));
+}
+
+#endif
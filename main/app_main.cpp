@@ -3,16 +3,13 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_sleep.h"
-#include "esp_log.h"
-#include "app_bme280.h"
 #include "app_zigbee.h"
-#include "app_battery.h"
 #include "app_button.h"
 #include "app_led.h"
-
-#define SECONDS_TO_SLEEP 120               // Время сна
-
-static const char *TAG = "Sensor";
+#include "app_log.h"
+#include "app_poll_control.h"
+#include "app_sampler.h"
+#include "app_store.h"
 
 // Проверка причины пробуждения
 void check_wakeup_reason(void)
@@ -21,13 +18,14 @@ void check_wakeup_reason(void)
     switch (cause)
     {
         case ESP_SLEEP_WAKEUP_TIMER:
-            ESP_LOGI(TAG, "Пробуждение по таймеру");
+            app_log(APP_LOG_WAKEUP_TIMER);
             break;
         case ESP_SLEEP_WAKEUP_EXT1:
-            ESP_LOGI(TAG, "Пробуждение по кнопке");
+            app_log(APP_LOG_WAKEUP_BUTTON);
             break;
         default:
-            ESP_LOGI(TAG, "Первый запуск / сброс");
+            app_log(APP_LOG_WAKEUP_RESET);
+            app_log_dump(); // После сброса выгружаем историю предыдущих пробуждений
             break;
     }
 }
@@ -35,34 +33,29 @@ void check_wakeup_reason(void)
 // Переход в глубокий сон
 void enter_deep_sleep(void)
 {
-    esp_sleep_enable_timer_wakeup(SECONDS_TO_SLEEP * 1000000);
-    ESP_LOGI(TAG, "Переход в глубокий сон...");
+    sensor_sample_t sample;
+    bool low_battery = app_store_get(STORE_KEY_LAST_SAMPLE, &sample, sizeof(sample)) && sample.battery_percent < STORE_LOW_BATTERY_PERCENT;
+    app_store_flush_if_due(low_battery);
+
+    esp_sleep_enable_timer_wakeup((uint64_t)poll_control_sleep_seconds() * 1000000);
+    app_log(APP_LOG_DEEP_SLEEP);
     esp_deep_sleep_start();
 }
 
+// Измерение и отправка отчета через диспетчер, ждем результат перед сном
 void send_data(void)
 {
-    float temp = read_temperature();
-    float hum = read_humidity();
-    float press = read_pressure() / 10;
-    float bat = read_battery_voltage();
-
-    uint8_t battery_percent = calc_battery_percent(bat);
-
-    update_temperature_value((int16_t)(temp * 100));
-    update_humidity_value((uint16_t)(hum * 100));
-    update_pressure_value((int16_t)(press * 10));
-    update_battery_percent_value(battery_percent);
-
-    ESP_LOGI(TAG, "Температура: %.2f °C", temp);
-    ESP_LOGI(TAG, "Влажность: %.2f %%", hum);
-    ESP_LOGI(TAG, "Давление: %.2f kPa", press);
-    ESP_LOGI(TAG, "Напряжение: %.2f V", bat);
+    sensor_sample_t sample;
+    if (sampler_request(&sample, SAMPLER_REQUEST_TIMEOUT_MS))
+    {
+        app_store_set(STORE_KEY_LAST_SAMPLE, &sample, sizeof(sample));
+    }
 }
 
 void send_data_once()
 {
     send_data();
+    poll_control_check_in();
     vTaskDelay(pdMS_TO_TICKS(500));
     enter_deep_sleep();
 }
@@ -75,6 +68,7 @@ void send_data_periodically()
         send_data();
     }
 
+    poll_control_check_in();
     vTaskDelay(pdMS_TO_TICKS(500));
     enter_deep_sleep();
 }
@@ -117,8 +111,15 @@ extern "C"
 
     void app_main(void)
     {
-        bme280_init();
-        adc_init();
+        app_log_init();
+        app_store_init();
+
+        // Счетчик пробуждений переживает замену батареи
+        uint32_t wake_count = 0;
+        app_store_get(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count));
+        wake_count++;
+        app_store_set(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count));
+
         check_wakeup_reason();
 
         // Создаем очередь для событий Zigbee
@@ -127,18 +128,25 @@ extern "C"
         // Регистрируем обработчики кнопок
         register_short_press_callback([]()
         {
-            send_data();
+            sampler_request(NULL, 0);
+        });
+
+        // Двойное нажатие - выгрузка истории по запросу, на обычном пути пробуждения UART не тратим
+        register_double_press_callback([]()
+        {
+            app_log_dump();
         });
 
         register_long_press_callback([]()
         {
-            ESP_LOGI(TAG, "Обнаружено долгое нажатие. Сброс сети ZigBee...");
+            app_log(APP_LOG_LONG_PRESS);
             led_turn_on(200);
             vTaskDelay(pdMS_TO_TICKS(2000));
             led_turn_off();
             factory_reset();
         });
 
+        xTaskCreate(sampler_task, "sampler", 4096, NULL, 5, &sampler_task_handle);
         xTaskCreate(button_task, "button_task", 4096, NULL, 6, NULL);
         xTaskCreate(led_task, "led_task", 2048, NULL, 6, NULL);
         xTaskCreate(zigbee_event_handler_task, "zigbee_event_handler", 4096, NULL, 5, NULL);
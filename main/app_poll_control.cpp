@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_attr.h"
+#include "esp_zigbee_core.h"
+#include "zcl/esp_zigbee_zcl_common.h"
+#include "zcl/esp_zigbee_zcl_poll_control.h"
+#include "zboss_api.h"
+#include "app_log.h"
+#include "app_poll_control.h"
+
+#define CHECK_IN_RESPONSE_BIT   BIT0
+#define FAST_POLL_STOP_BIT      BIT1
+
+typedef struct
+{
+    uint32_t check_in_interval_qs;
+    uint32_t long_poll_interval_qs;     // Он же период пробуждений
+    uint16_t short_poll_interval_qs;
+    uint16_t fast_poll_timeout_qs;
+    uint32_t qs_since_check_in;
+} poll_control_config_t;
+
+// Настройки от координатора и время с последнего check-in переживают глубокий сон.
+// После холодного старта check-in отправляется сразу.
+static RTC_DATA_ATTR poll_control_config_t config = {
+    .check_in_interval_qs = POLL_CONTROL_CHECK_IN_INTERVAL_QS,
+    .long_poll_interval_qs = POLL_CONTROL_LONG_POLL_INTERVAL_QS,
+    .short_poll_interval_qs = POLL_CONTROL_SHORT_POLL_INTERVAL_QS,
+    .fast_poll_timeout_qs = POLL_CONTROL_FAST_POLL_TIMEOUT_QS,
+    .qs_since_check_in = UINT32_MAX,
+};
+
+static EventGroupHandle_t poll_control_events = NULL;
+static uint16_t fast_poll_timeout_qs = 0;
+static uint16_t fast_poll_timeout_max_qs = POLL_CONTROL_FAST_POLL_TIMEOUT_MAX_QS;
+
+static uint32_t get_attribute_value(uint16_t attr_id)
+{
+    esp_zb_zcl_attr_t *attr = esp_zb_zcl_get_attribute(HA_ESP_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, attr_id);
+    if (!attr || !attr->data_p)
+    {
+        return 0;
+    }
+
+    return attr->type == ESP_ZB_ZCL_ATTR_TYPE_U32 ? *(uint32_t *)attr->data_p : *(uint16_t *)attr->data_p;
+}
+
+static void set_attribute_value(uint16_t attr_id, void *value_p)
+{
+    esp_zb_zcl_set_attribute_val(HA_ESP_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, attr_id, value_p, false);
+}
+
+// Вызывать из контекста стека или под esp_zb_lock
+static void start_fast_poll(uint32_t timeout_ms)
+{
+    zb_zdo_pim_set_fast_poll_interval(config.short_poll_interval_qs * 250);
+    zb_zdo_pim_set_fast_poll_timeout(timeout_ms);
+    zb_zdo_pim_start_fast_poll(0);
+}
+
+// Проверка записи атрибутов клиентом, до изменения значения.
+// Check-in не чаще long poll, таймаут fast poll ненулевой и не больше FastPollTimeoutMax.
+static esp_err_t check_attribute_value(uint16_t attr_id, uint8_t endpoint, uint8_t *value)
+{
+    if (endpoint != HA_ESP_SENSOR_ENDPOINT)
+    {
+        return ESP_OK;
+    }
+
+    switch (attr_id)
+    {
+        case ESP_ZB_ZCL_ATTR_POLL_CONTROL_CHECK_IN_INTERVAL_ID:
+        {
+            uint32_t interval;
+            memcpy(&interval, value, sizeof(interval));
+            if (interval < config.long_poll_interval_qs)
+            {
+                app_log(APP_LOG_POLL_INVALID_ATTR, attr_id, interval);
+                return ESP_ERR_INVALID_ARG;
+            }
+            break;
+        }
+        case ESP_ZB_ZCL_ATTR_POLL_CONTROL_FAST_POLL_TIMEOUT_ID:
+        {
+            uint16_t timeout;
+            memcpy(&timeout, value, sizeof(timeout));
+            if (timeout == 0 || timeout > fast_poll_timeout_max_qs)
+            {
+                app_log(APP_LOG_POLL_INVALID_ATTR, attr_id, timeout);
+                return ESP_ERR_INVALID_ARG;
+            }
+            break;
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Кластер регистрируется как custom, чтобы команды клиента приходили в приложение:
+// от них зависит, когда можно уходить в глубокий сон
+esp_zb_attribute_list_t *poll_control_cluster_create(void)
+{
+    poll_control_events = xEventGroupCreate();
+
+    esp_zb_attribute_list_t *poll_attr_list = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL);
+    ESP_ERROR_CHECK(esp_zb_cluster_add_attr(poll_attr_list, ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL, ESP_ZB_ZCL_ATTR_POLL_CONTROL_CHECK_IN_INTERVAL_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &config.check_in_interval_qs));
+    ESP_ERROR_CHECK(esp_zb_cluster_add_attr(poll_attr_list, ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL, ESP_ZB_ZCL_ATTR_POLL_CONTROL_LONG_POLL_INTERVAL_ID, ESP_ZB_ZCL_ATTR_TYPE_U32, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &config.long_poll_interval_qs));
+    ESP_ERROR_CHECK(esp_zb_cluster_add_attr(poll_attr_list, ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL, ESP_ZB_ZCL_ATTR_POLL_CONTROL_SHORT_POLL_INTERVAL_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &config.short_poll_interval_qs));
+    ESP_ERROR_CHECK(esp_zb_cluster_add_attr(poll_attr_list, ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL, ESP_ZB_ZCL_ATTR_POLL_CONTROL_FAST_POLL_TIMEOUT_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &config.fast_poll_timeout_qs));
+    ESP_ERROR_CHECK(esp_zb_cluster_add_attr(poll_attr_list, ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL, ESP_ZB_ZCL_ATTR_POLL_CONTROL_FAST_POLL_TIMEOUT_MAX_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &fast_poll_timeout_max_qs));
+
+    esp_zb_zcl_custom_cluster_handlers_t handlers = {
+        .cluster_id = ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL,
+        .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        .check_value_cb = check_attribute_value,
+        .write_attr_cb = NULL,
+    };
+    ESP_ERROR_CHECK(esp_zb_zcl_custom_cluster_handlers_update(handlers));
+
+    return poll_attr_list;
+}
+
+// Вызывается из контекста стека Zigbee (action handler).
+// Ошибка в ответ на команду стек отправляет клиенту в Default Response.
+esp_err_t poll_control_handle_command(const esp_zb_zcl_custom_cluster_command_message_t *message)
+{
+    if (message->info.cluster != ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL)
+    {
+        return ESP_OK;
+    }
+
+    const uint8_t *data = (const uint8_t *)message->data.value;
+    uint16_t size = message->data.size;
+
+    switch (message->info.command.id)
+    {
+        case POLL_CONTROL_CMD_CHECK_IN_RESPONSE:
+        {
+            if (size < 3)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            bool start_fast_polling = data[0];
+            uint16_t timeout_qs = data[1] | data[2] << 8;
+            if (start_fast_polling && timeout_qs > fast_poll_timeout_max_qs)
+            {
+                // По спецификации такой ответ отклоняется, fast poll не запускается
+                app_log(APP_LOG_POLL_INVALID_VALUE, message->info.command.id, timeout_qs);
+                fast_poll_timeout_qs = 0;
+                xEventGroupSetBits(poll_control_events, CHECK_IN_RESPONSE_BIT);
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            if (start_fast_polling)
+            {
+                fast_poll_timeout_qs = timeout_qs ? timeout_qs : get_attribute_value(ESP_ZB_ZCL_ATTR_POLL_CONTROL_FAST_POLL_TIMEOUT_ID);
+                start_fast_poll(fast_poll_timeout_qs * 250);
+                app_log(APP_LOG_POLL_FAST_POLL_START, fast_poll_timeout_qs);
+            }
+            else
+            {
+                fast_poll_timeout_qs = 0;
+            }
+            xEventGroupSetBits(poll_control_events, CHECK_IN_RESPONSE_BIT);
+            break;
+        }
+        case POLL_CONTROL_CMD_FAST_POLL_STOP:
+            zb_zdo_pim_stop_fast_poll(0);
+            app_log(APP_LOG_POLL_FAST_POLL_STOP);
+            xEventGroupSetBits(poll_control_events, FAST_POLL_STOP_BIT);
+            break;
+        case POLL_CONTROL_CMD_SET_LONG_POLL_INTERVAL:
+        {
+            if (size < 4)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            // Short Poll <= Long Poll <= Check-in, и не дольше половины таймаута родителя
+            uint32_t interval = data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+            if (interval < POLL_CONTROL_LONG_POLL_INTERVAL_MIN_QS || interval > POLL_CONTROL_LONG_POLL_INTERVAL_MAX_QS ||
+                interval < config.short_poll_interval_qs || interval > config.check_in_interval_qs)
+            {
+                app_log(APP_LOG_POLL_INVALID_VALUE, message->info.command.id, interval);
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            // Long poll задает период пробуждений, а значит и отчетов: между ними радио выключено
+            config.long_poll_interval_qs = interval;
+            set_attribute_value(ESP_ZB_ZCL_ATTR_POLL_CONTROL_LONG_POLL_INTERVAL_ID, &interval);
+            break;
+        }
+        case POLL_CONTROL_CMD_SET_SHORT_POLL_INTERVAL:
+        {
+            if (size < 2)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            uint16_t interval = data[0] | data[1] << 8;
+            if (interval == 0 || interval > config.long_poll_interval_qs)
+            {
+                app_log(APP_LOG_POLL_INVALID_VALUE, message->info.command.id, interval);
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            // Применяется при следующем запуске fast poll
+            config.short_poll_interval_qs = interval;
+            set_attribute_value(ESP_ZB_ZCL_ATTR_POLL_CONTROL_SHORT_POLL_INTERVAL_ID, &interval);
+            break;
+        }
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    return ESP_OK;
+}
+
+uint32_t poll_control_sleep_seconds(void)
+{
+    uint32_t seconds = config.long_poll_interval_qs / 4;
+    return seconds ? seconds : 1;
+}
+
+static bool is_check_in_due(void)
+{
+    // Записываемые атрибуты могли измениться клиентом, сохраняем их на время сна
+    esp_zb_lock_acquire(portMAX_DELAY);
+    config.check_in_interval_qs = get_attribute_value(ESP_ZB_ZCL_ATTR_POLL_CONTROL_CHECK_IN_INTERVAL_ID);
+    config.fast_poll_timeout_qs = get_attribute_value(ESP_ZB_ZCL_ATTR_POLL_CONTROL_FAST_POLL_TIMEOUT_ID);
+    esp_zb_lock_release();
+
+    if (config.qs_since_check_in <= UINT32_MAX - config.long_poll_interval_qs)
+    {
+        config.qs_since_check_in += config.long_poll_interval_qs;
+    }
+    else
+    {
+        config.qs_since_check_in = UINT32_MAX;
+    }
+
+    return config.qs_since_check_in >= config.check_in_interval_qs;
+}
+
+// Check-in выполняется не чаще интервала из атрибута, с шагом в одно пробуждение.
+// Пока ждем ответ, родитель опрашивается с коротким интервалом: иначе ответ, который он
+// держит до следующего data poll, может прийти уже после окна ожидания.
+// Если клиент запросил fast poll, функция держит устройство бодрствующим до Fast Poll Stop
+// или до истечения таймаута, иначе возвращается сразу и радио уходит в сон.
+void poll_control_check_in(void)
+{
+    if (!is_check_in_due())
+    {
+        return;
+    }
+
+    config.qs_since_check_in = 0;
+    fast_poll_timeout_qs = 0;
+    xEventGroupClearBits(poll_control_events, CHECK_IN_RESPONSE_BIT | FAST_POLL_STOP_BIT);
+
+    esp_zb_zcl_custom_cluster_cmd_req_t check_in_cmd = {};
+    check_in_cmd.zcl_basic_cmd.src_endpoint = HA_ESP_SENSOR_ENDPOINT;
+    check_in_cmd.address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT; // Всем клиентам из таблицы привязок
+    check_in_cmd.profile_id = ESP_ZB_AF_HA_PROFILE_ID;
+    check_in_cmd.cluster_id = ESP_ZB_ZCL_CLUSTER_ID_POLL_CONTROL;
+    check_in_cmd.custom_cmd_id = POLL_CONTROL_CMD_CHECK_IN;
+    check_in_cmd.direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI;
+    check_in_cmd.data.type = ESP_ZB_ZCL_ATTR_TYPE_NULL;
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_zb_zcl_custom_cluster_cmd_req(&check_in_cmd);
+    start_fast_poll(POLL_CONTROL_CHECK_IN_RESPONSE_MS);
+    esp_zb_lock_release();
+    app_log(APP_LOG_POLL_CHECK_IN);
+
+    EventBits_t bits = xEventGroupWaitBits(poll_control_events, CHECK_IN_RESPONSE_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(POLL_CONTROL_CHECK_IN_RESPONSE_MS));
+    if ((bits & CHECK_IN_RESPONSE_BIT) && fast_poll_timeout_qs != 0)
+    {
+        bits = xEventGroupWaitBits(poll_control_events, FAST_POLL_STOP_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(fast_poll_timeout_qs * 250));
+        if (bits & FAST_POLL_STOP_BIT)
+        {
+            return;
+        }
+    }
+
+    // Нет ответа, fast poll не запрошен или истек таймаут
+    esp_zb_lock_acquire(portMAX_DELAY);
+    zb_zdo_pim_stop_fast_poll(0);
+    esp_zb_lock_release();
+}
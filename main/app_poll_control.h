@@ -0,0 +1,33 @@
+#ifndef APP_POLL_CONTROL_H
+#define APP_POLL_CONTROL_H
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_zigbee_core.h"
+#include "app_zigbee.h"
+
+// Интервалы Poll Control задаются в четвертях секунды (qs)
+#define POLL_CONTROL_CHECK_IN_WAKES             30                              // Check-in раз в 30 пробуждений (~1 час)
+#define POLL_CONTROL_CHECK_IN_INTERVAL_QS       (POLL_CONTROL_CHECK_IN_WAKES * SECONDS_TO_SLEEP * 4)
+#define POLL_CONTROL_LONG_POLL_INTERVAL_QS      (SECONDS_TO_SLEEP * 4)          // Период пробуждений, между ними радио выключено
+#define POLL_CONTROL_LONG_POLL_INTERVAL_MIN_QS  0x04                            // Минимум из спецификации ZCL
+#define POLL_CONTROL_LONG_POLL_INTERVAL_MAX_QS  (ED_AGING_TIMEOUT_S / 2 * 4)    // Половина таймаута родителя: одно сорванное
+                                                                                // пробуждение не приводит к rejoin
+#define POLL_CONTROL_SHORT_POLL_INTERVAL_QS     2                               // 0.5 c во время fast poll
+#define POLL_CONTROL_FAST_POLL_TIMEOUT_QS       (10 * 4)                        // 10 c
+#define POLL_CONTROL_FAST_POLL_TIMEOUT_MAX_QS   (60 * 4)                        // Дольше минуты радио не держим
+#define POLL_CONTROL_CHECK_IN_RESPONSE_MS       2000
+
+#define POLL_CONTROL_CMD_CHECK_IN               0x00 // Сервер -> клиент
+#define POLL_CONTROL_CMD_CHECK_IN_RESPONSE      0x00 // Клиент -> сервер
+#define POLL_CONTROL_CMD_FAST_POLL_STOP         0x01
+#define POLL_CONTROL_CMD_SET_LONG_POLL_INTERVAL 0x02
+#define POLL_CONTROL_CMD_SET_SHORT_POLL_INTERVAL 0x03
+
+esp_zb_attribute_list_t *poll_control_cluster_create(void);
+esp_err_t poll_control_handle_command(const esp_zb_zcl_custom_cluster_command_message_t *message);
+void poll_control_check_in(void);
+uint32_t poll_control_sleep_seconds(void);
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "app_bme280.h"
+#include "app_battery.h"
+#include "app_zigbee.h"
+#include "app_log.h"
+#include "app_sampler.h"
+
+TaskHandle_t sampler_task_handle = NULL;
+
+static portMUX_TYPE sample_lock = portMUX_INITIALIZER_UNLOCKED;
+
+sampler_task_t sampler_port_current_task(void)
+{
+    return xTaskGetCurrentTaskHandle();
+}
+
+sampler_task_t sampler_port_dispatcher(void)
+{
+    return sampler_task_handle;
+}
+
+void sampler_port_notify(sampler_task_t task)
+{
+    xTaskNotifyGive((TaskHandle_t)task);
+}
+
+uint32_t sampler_port_wait(uint32_t timeout_ms)
+{
+    return ulTaskNotifyTake(pdTRUE, timeout_ms == SAMPLER_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+}
+
+void sampler_port_delay_ms(uint32_t ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void sampler_port_lock(void)
+{
+    portENTER_CRITICAL(&sample_lock);
+}
+
+void sampler_port_unlock(void)
+{
+    portEXIT_CRITICAL(&sample_lock);
+}
+
+static void sample_and_report(sensor_sample_t *sample)
+{
+    float bat = read_battery_voltage();
+
+    sample->temperature = (int16_t)(read_temperature() * 100);
+    sample->humidity = (uint16_t)(read_humidity() * 100);
+    sample->pressure = (int16_t)read_pressure(); // гПа = 0.1 kPa
+    sample->battery_mv = (uint16_t)(bat * 1000);
+    sample->battery_percent = calc_battery_percent(bat);
+
+    update_temperature_value(sample->temperature);
+    update_humidity_value(sample->humidity);
+    update_pressure_value(sample->pressure);
+    update_battery_percent_value(sample->battery_percent);
+
+    app_log(APP_LOG_TEMPERATURE, sample->temperature);
+    app_log(APP_LOG_HUMIDITY, sample->humidity);
+    app_log(APP_LOG_PRESSURE, sample->pressure);
+    app_log(APP_LOG_BATTERY, sample->battery_mv, sample->battery_percent);
+}
+
+// Единственная задача, работающая с датчиками: I2C и АЦП не используются параллельно,
+// а одновременные запросы от кнопки и цикла отправки дают одно измерение и один отчет
+void sampler_task(void *pvParameters)
+{
+    bme280_init();
+    adc_init();
+
+    while (1)
+    {
+        sampler_dispatch(sample_and_report);
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef APP_SAMPLER_H
+#define APP_SAMPLER_H
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "app_sampler_core.h"
+
+extern TaskHandle_t sampler_task_handle;
+
+void sampler_task(void *pvParameters);
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <atomic>
+#include "app_sampler_core.h"
+
+// Задачи, ожидающие результат. Слот занимается через CAS без блокировок,
+// диспетчер забирает все слоты перед измерением.
+static std::atomic<sampler_task_t> waiters[SAMPLER_MAX_WAITERS];
+
+// Запрос без ожидания результата (кнопка). Уведомление само по себе не означает запрос:
+// оно могло остаться от задачи, которую уже обслужило предыдущее измерение.
+static std::atomic<bool> report_requested{false};
+
+static sensor_sample_t last_sample = {};
+
+static bool register_waiter(sampler_task_t task)
+{
+    for (size_t i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        sampler_task_t expected = NULL;
+        if (waiters[i].compare_exchange_strong(expected, task))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool unregister_waiter(sampler_task_t task)
+{
+    for (size_t i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        sampler_task_t expected = task;
+        if (waiters[i].compare_exchange_strong(expected, NULL))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Запрос измерения из любой задачи. С sample == NULL запрос только ставится в очередь,
+// иначе функция ждет ближайшее измерение, покрывающее этот запрос, и копирует результат.
+bool sampler_request(sensor_sample_t *sample, uint32_t timeout_ms)
+{
+    sampler_task_t dispatcher = sampler_port_dispatcher();
+    if (!sample)
+    {
+        report_requested = true;
+        sampler_port_notify(dispatcher);
+        return true;
+    }
+
+    sampler_task_t self = sampler_port_current_task();
+    if (!register_waiter(self))
+    {
+        sampler_port_notify(dispatcher);
+        return false;
+    }
+
+    // Слот занимаем до уведомления диспетчера, иначе запрос может попасть в уже начатое измерение
+    sampler_port_notify(dispatcher);
+
+    if (!sampler_port_wait(timeout_ms))
+    {
+        if (unregister_waiter(self))
+        {
+            return false;
+        }
+
+        // Диспетчер уже забрал слот - уведомление обязательно придет
+        sampler_port_wait(SAMPLER_WAIT_FOREVER);
+    }
+
+    sampler_port_lock();
+    *sample = last_sample;
+    sampler_port_unlock();
+
+    return true;
+}
+
+// Один цикл диспетчера: ждет запрос, собирает запросы из окна, делает одно измерение
+// и уведомляет каждую ожидающую задачу ровно один раз
+void sampler_dispatch(sampler_acquire_cb acquire)
+{
+    sampler_port_wait(SAMPLER_WAIT_FOREVER);
+
+    sampler_port_delay_ms(SAMPLER_COALESCE_WINDOW_MS);
+    sampler_port_wait(0); // Запросы из окна обслуживает это же измерение
+
+    // Задача может занять слот до exchange, а уведомить уже после wait(0) выше:
+    // ее обслужит это измерение, а лишнее уведомление разбудит следующий цикл впустую
+    bool requested = report_requested.exchange(false);
+    sampler_task_t served[SAMPLER_MAX_WAITERS];
+    for (size_t i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        served[i] = waiters[i].exchange(NULL);
+        requested |= served[i] != NULL;
+    }
+
+    if (!requested)
+    {
+        return;
+    }
+
+    sensor_sample_t sample;
+    acquire(&sample);
+
+    sampler_port_lock();
+    last_sample = sample;
+    sampler_port_unlock();
+
+    for (size_t i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        if (served[i])
+        {
+            sampler_port_notify(served[i]);
+        }
+    }
+}
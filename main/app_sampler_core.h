@@ -0,0 +1,37 @@
+#ifndef APP_SAMPLER_CORE_H
+#define APP_SAMPLER_CORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define SAMPLER_COALESCE_WINDOW_MS  50  // Запросы внутри окна объединяются в одно измерение
+#define SAMPLER_MAX_WAITERS         4   // Сколько задач могут одновременно ждать результат
+#define SAMPLER_REQUEST_TIMEOUT_MS  3000
+#define SAMPLER_WAIT_FOREVER        UINT32_MAX
+
+typedef struct
+{
+    int16_t temperature;        // 0.01 °C
+    uint16_t humidity;          // 0.01 %
+    int16_t pressure;           // 0.1 kPa
+    uint16_t battery_mv;
+    uint8_t battery_percent;
+} sensor_sample_t;
+
+typedef void *sampler_task_t;
+typedef void (*sampler_acquire_cb)(sensor_sample_t *sample);
+
+// Платформенная прослойка: на устройстве - уведомления FreeRTOS (app_sampler.cpp),
+// в host-тестах - потоки std::thread
+sampler_task_t sampler_port_current_task(void);
+sampler_task_t sampler_port_dispatcher(void);
+void sampler_port_notify(sampler_task_t task);
+uint32_t sampler_port_wait(uint32_t timeout_ms); // Забирает все уведомления текущей задачи, 0 - таймаут
+void sampler_port_delay_ms(uint32_t ms);
+void sampler_port_lock(void);
+void sampler_port_unlock(void);
+
+bool sampler_request(sensor_sample_t *sample, uint32_t timeout_ms);
+void sampler_dispatch(sampler_acquire_cb acquire);
+
+#endif
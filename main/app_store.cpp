@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "esp_attr.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "app_log.h"
+#include "app_store.h"
+
+#define STORE_MAGIC             0x53505041 // "APPS"
+#define STORE_SECTOR_SIZE       4096
+#define STORE_EMPTY             0xFFFFFFFF
+
+// Флеш-раздел - кольцо секторов, в каждом заголовок и записи фиксированного размера,
+// дописываемые подряд. Актуально значение ключа с наибольшим seq.
+// Сектор после головного всегда стерт: при переходе в него живые записи самого
+// старого сектора сначала копируются, и только потом старый сектор стирается.
+// Если питание пропало между этими шагами, сборку доделывает store_load.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+} store_sector_header_t;
+
+typedef struct
+{
+    uint32_t seq;
+    uint8_t key;
+    uint8_t len;
+    uint16_t crc;
+    uint8_t data[STORE_MAX_VALUE_SIZE];
+} store_record_t;
+
+#define STORE_RECORDS_PER_SECTOR ((STORE_SECTOR_SIZE - sizeof(store_sector_header_t)) / sizeof(store_record_t))
+
+typedef struct
+{
+    uint32_t seq;       // 0 - значения нет
+    uint8_t len;
+    uint8_t sector;     // Где лежит последняя копия во flash
+    bool dirty;
+    uint8_t data[STORE_MAX_VALUE_SIZE];
+} store_entry_t;
+
+// Кэш в RTC-памяти: между пробуждениями значения меняются только здесь
+typedef struct
+{
+    uint32_t magic;
+    uint32_t record_seq;
+    uint32_t sector_seq;
+    uint16_t wakes_since_flush;
+    uint16_t head_record;
+    uint8_t head_sector;
+    store_entry_t entries[STORE_KEY_COUNT];
+} store_cache_t;
+
+static RTC_DATA_ATTR store_cache_t cache;
+
+static const esp_partition_t *partition = NULL;
+static uint8_t sector_count = 0;
+
+static size_t record_offset(uint8_t sector, uint16_t index)
+{
+    return sector * STORE_SECTOR_SIZE + sizeof(store_sector_header_t) + index * sizeof(store_record_t);
+}
+
+static uint16_t record_crc(const store_record_t *record)
+{
+    uint16_t crc = esp_rom_crc16_le(0, (const uint8_t *)record, offsetof(store_record_t, crc));
+    return esp_rom_crc16_le(crc, record->data, record->len);
+}
+
+static bool store_check(esp_err_t err)
+{
+    if (err != ESP_OK)
+    {
+        app_log(APP_LOG_STORE_ERROR, err);
+        return false;
+    }
+    return true;
+}
+
+// Проверяется весь сектор: после частичного стирания заголовок может быть чистым,
+// а дальше остаться старые данные
+static bool store_sector_is_blank(uint8_t sector)
+{
+    uint32_t chunk[64];
+    for (size_t offset = 0; offset < STORE_SECTOR_SIZE; offset += sizeof(chunk))
+    {
+        if (esp_partition_read(partition, sector * STORE_SECTOR_SIZE + offset, chunk, sizeof(chunk)) != ESP_OK)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < sizeof(chunk) / sizeof(chunk[0]); i++)
+        {
+            if (chunk[i] != STORE_EMPTY)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool store_start_sector(uint8_t sector)
+{
+    if (!store_sector_is_blank(sector) &&
+        !store_check(esp_partition_erase_range(partition, sector * STORE_SECTOR_SIZE, STORE_SECTOR_SIZE)))
+    {
+        return false;
+    }
+
+    store_sector_header_t header;
+    header.magic = STORE_MAGIC;
+    header.seq = ++cache.sector_seq;
+    if (!store_check(esp_partition_write(partition, sector * STORE_SECTOR_SIZE, &header, sizeof(header))))
+    {
+        return false;
+    }
+
+    cache.head_sector = sector;
+    cache.head_record = 0;
+    return true;
+}
+
+static bool store_append(uint8_t key);
+
+// Сборка мусора: живые записи сектора копируются в головной, затем сектор стирается
+static bool store_collect(uint8_t sector)
+{
+    for (uint8_t key = 0; key < STORE_KEY_COUNT; key++)
+    {
+        if (cache.entries[key].seq != 0 && cache.entries[key].sector == sector && !store_append(key))
+        {
+            return false;
+        }
+    }
+
+    return store_check(esp_partition_erase_range(partition, sector * STORE_SECTOR_SIZE, STORE_SECTOR_SIZE));
+}
+
+// Переход в следующий (стертый) сектор и сборка мусора в самом старом
+static bool store_advance(void)
+{
+    if (!store_start_sector((cache.head_sector + 1) % sector_count))
+    {
+        return false;
+    }
+
+    return store_collect((cache.head_sector + 1) % sector_count);
+}
+
+static bool store_append(uint8_t key)
+{
+    if (cache.head_record >= STORE_RECORDS_PER_SECTOR && !store_advance())
+    {
+        return false;
+    }
+
+    store_entry_t *entry = &cache.entries[key];
+    store_record_t record;
+    memset(&record, 0xFF, sizeof(record));
+    record.seq = cache.record_seq + 1;
+    record.key = key;
+    record.len = entry->len;
+    memcpy(record.data, entry->data, entry->len);
+    record.crc = record_crc(&record);
+
+    // Слот и seq расходуются даже при ошибке: повторное программирование наполовину
+    // записанного слота на NOR дает мусор, а store_load пропускает такой слот по CRC
+    esp_err_t err = esp_partition_write(partition, record_offset(cache.head_sector, cache.head_record), &record, sizeof(record));
+    cache.record_seq = record.seq;
+    cache.head_record++;
+    if (!store_check(err))
+    {
+        return false;
+    }
+
+    entry->seq = record.seq;
+    entry->sector = cache.head_sector;
+    entry->dirty = false;
+    return true;
+}
+
+// Восстановление кэша из flash после холодного старта
+static void store_load(void)
+{
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = STORE_MAGIC;
+
+    bool found = false;
+    for (uint8_t sector = 0; sector < sector_count; sector++)
+    {
+        // Оборванная запись заголовка оставляет seq чистым - такой сектор не начат
+        store_sector_header_t header;
+        if (esp_partition_read(partition, sector * STORE_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK ||
+            header.magic != STORE_MAGIC || header.seq == STORE_EMPTY)
+        {
+            continue;
+        }
+
+        if (!found || header.seq > cache.sector_seq)
+        {
+            found = true;
+            cache.sector_seq = header.seq;
+            cache.head_sector = sector;
+        }
+
+        for (uint16_t index = 0; index < STORE_RECORDS_PER_SECTOR; index++)
+        {
+            store_record_t record;
+            if (esp_partition_read(partition, record_offset(sector, index), &record, sizeof(record)) != ESP_OK || record.seq == STORE_EMPTY)
+            {
+                break;
+            }
+
+            // Оборванная запись или мусор после частичного стирания
+            if (record.key >= STORE_KEY_COUNT || record.len > STORE_MAX_VALUE_SIZE || record.crc != record_crc(&record))
+            {
+                continue;
+            }
+
+            if (record.seq > cache.record_seq)
+            {
+                cache.record_seq = record.seq;
+            }
+
+            store_entry_t *entry = &cache.entries[record.key];
+            if (record.seq > entry->seq)
+            {
+                entry->seq = record.seq;
+                entry->len = record.len;
+                entry->sector = sector;
+                memcpy(entry->data, record.data, record.len);
+            }
+        }
+    }
+
+    if (!found)
+    {
+        store_start_sector(0);
+        return;
+    }
+
+    store_record_t record;
+    while (cache.head_record < STORE_RECORDS_PER_SECTOR &&
+           esp_partition_read(partition, record_offset(cache.head_sector, cache.head_record), &record, sizeof(record)) == ESP_OK &&
+           record.seq != STORE_EMPTY)
+    {
+        cache.head_record++;
+    }
+
+    // Питание пропало между переходом в новый сектор и сборкой самого старого:
+    // в нем могут остаться единственные копии записей, доделываем сборку.
+    // Головной сектор в этом случае только начат и места для копий в нем хватает,
+    // а если оборвался заголовок самого старого, записей из него в кэше нет.
+    uint8_t oldest = (cache.head_sector + 1) % sector_count;
+    if (!store_sector_is_blank(oldest))
+    {
+        store_collect(oldest);
+    }
+
+    app_log(APP_LOG_STORE_LOADED, cache.head_sector, cache.head_record, cache.record_seq);
+}
+
+void app_store_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)STORE_PARTITION_SUBTYPE, STORE_PARTITION_LABEL);
+    if (!partition)
+    {
+        app_log(APP_LOG_STORE_ERROR, ESP_ERR_NOT_FOUND);
+        return;
+    }
+
+    // Нужен хотя бы один сектор под запись, один стертый в запасе и один старый
+    sector_count = partition->size / STORE_SECTOR_SIZE;
+    if (sector_count < 3)
+    {
+        app_log(APP_LOG_STORE_ERROR, ESP_ERR_INVALID_SIZE);
+        partition = NULL;
+        return;
+    }
+
+    if (cache.magic != STORE_MAGIC)
+    {
+        store_load();
+    }
+
+    cache.wakes_since_flush++;
+}
+
+bool app_store_get(app_store_key_t key, void *value, uint8_t len)
+{
+    const store_entry_t *entry = &cache.entries[key];
+    if ((entry->seq == 0 && !entry->dirty) || entry->len != len)
+    {
+        return false;
+    }
+
+    memcpy(value, entry->data, len);
+    return true;
+}
+
+// Меняет только кэш в RTC-памяти, во flash значение попадет при ближайшем сбросе кэша
+void app_store_set(app_store_key_t key, const void *value, uint8_t len)
+{
+    if (len > STORE_MAX_VALUE_SIZE)
+    {
+        return;
+    }
+
+    store_entry_t *entry = &cache.entries[key];
+    if (entry->len == len && memcmp(entry->data, value, len) == 0 && (entry->seq != 0 || entry->dirty))
+    {
+        return;
+    }
+
+    entry->len = len;
+    memcpy(entry->data, value, len);
+    entry->dirty = true;
+}
+
+void app_store_flush_if_due(bool force)
+{
+    if (!partition || (!force && cache.wakes_since_flush < STORE_FLUSH_WAKES))
+    {
+        return;
+    }
+
+    uint8_t written = 0;
+    for (uint8_t key = 0; key < STORE_KEY_COUNT; key++)
+    {
+        if (!cache.entries[key].dirty)
+        {
+            continue;
+        }
+
+        if (!store_append(key))
+        {
+            return;
+        }
+        written++;
+    }
+
+    cache.wakes_since_flush = 0;
+    if (written)
+    {
+        app_log(APP_LOG_STORE_FLUSH, written, cache.head_sector, cache.head_record);
+    }
+}
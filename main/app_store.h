@@ -0,0 +1,26 @@
+#ifndef APP_STORE_H
+#define APP_STORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define STORE_PARTITION_LABEL       "app_store"
+#define STORE_PARTITION_SUBTYPE     0x40
+#define STORE_FLUSH_WAKES           30  // Запись во flash не чаще раза в 30 пробуждений (~1 час)
+#define STORE_LOW_BATTERY_PERCENT   10  // При разряженной батарее сбрасываем кэш на каждом сне
+#define STORE_MAX_VALUE_SIZE        16
+
+// Ключи записей. Номера пишутся во flash, новые ключи добавлять только в конец.
+typedef enum
+{
+    STORE_KEY_WAKE_COUNT,
+    STORE_KEY_LAST_SAMPLE,
+    STORE_KEY_COUNT
+} app_store_key_t;
+
+void app_store_init(void);
+bool app_store_get(app_store_key_t key, void *value, uint8_t len);
+void app_store_set(app_store_key_t key, const void *value, uint8_t len);
+void app_store_flush_if_due(bool force);
+
+#endif
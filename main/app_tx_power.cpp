@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include "app_tx_power.h"
+
+static bool set_power(tx_power_state_t *state, int power_dbm)
+{
+    if (power_dbm < TX_POWER_MIN_DBM)
+        power_dbm = TX_POWER_MIN_DBM;
+
+    if (power_dbm > TX_POWER_MAX_DBM)
+        power_dbm = TX_POWER_MAX_DBM;
+
+    if (power_dbm == state->power_dbm)
+    {
+        return false;
+    }
+
+    state->power_dbm = (int8_t)power_dbm;
+    state->stable_frames = 0;
+    return true;
+}
+
+// Запас линка в сторону родителя. RSSI измеряется на кадрах родителя, поэтому
+// считаем, что он передает на максимуме, а наш сигнал у него слабее на разницу мощностей.
+static int uplink_margin_db(const tx_power_state_t *state)
+{
+    return tx_power_rssi_dbm(state) - TX_POWER_RX_SENSITIVITY_DBM - (TX_POWER_MAX_DBM - state->power_dbm);
+}
+
+// Шаг вниз считается по кадрам с новым RSSI: кадр дает и LQI, и RSSI, а LQI
+// без нового RSSI запас не меняет, поэтому только повышает мощность
+static bool evaluate(tx_power_state_t *state, bool rssi_updated)
+{
+    bool rssi_known = state->rssi_avg != TX_POWER_RSSI_UNKNOWN;
+    bool lqi_known = state->lqi_avg != 0;
+
+    if ((rssi_known && uplink_margin_db(state) < TX_POWER_MARGIN_LOW_DB) || (lqi_known && tx_power_lqi(state) < TX_POWER_LQI_LOW))
+    {
+        return set_power(state, state->power_dbm + TX_POWER_STEP_DB);
+    }
+
+    if (!rssi_updated)
+    {
+        return false;
+    }
+
+    if (rssi_known && uplink_margin_db(state) > TX_POWER_MARGIN_HIGH_DB)
+    {
+        if (++state->stable_frames >= TX_POWER_STABLE_FRAMES)
+        {
+            return set_power(state, state->power_dbm - TX_POWER_STEP_DB);
+        }
+        return false;
+    }
+
+    state->stable_frames = 0;
+    return false;
+}
+
+void tx_power_reset(tx_power_state_t *state)
+{
+    tx_power_state_t defaults = TX_POWER_STATE_DEFAULT;
+    *state = defaults;
+}
+
+static int round_avg(int avg)
+{
+    return (avg >= 0 ? avg + TX_POWER_AVG_SCALE / 2 : avg - TX_POWER_AVG_SCALE / 2) / TX_POWER_AVG_SCALE;
+}
+
+int8_t tx_power_rssi_dbm(const tx_power_state_t *state)
+{
+    return state->rssi_avg == TX_POWER_RSSI_UNKNOWN ? 0 : (int8_t)round_avg(state->rssi_avg);
+}
+
+uint8_t tx_power_lqi(const tx_power_state_t *state)
+{
+    return (uint8_t)round_avg(state->lqi_avg);
+}
+
+bool tx_power_on_rssi(tx_power_state_t *state, int8_t rssi)
+{
+    // Экспоненциальное сглаживание с весом 1/4
+    if (state->rssi_avg == TX_POWER_RSSI_UNKNOWN)
+        state->rssi_avg = rssi * TX_POWER_AVG_SCALE;
+    else
+        state->rssi_avg += (rssi * TX_POWER_AVG_SCALE - state->rssi_avg) / 4;
+
+    return evaluate(state, true);
+}
+
+bool tx_power_on_lqi(tx_power_state_t *state, uint8_t lqi)
+{
+    if (lqi == 0)
+        lqi = 1;
+
+    if (state->lqi_avg == 0)
+        state->lqi_avg = lqi * TX_POWER_AVG_SCALE;
+    else
+        state->lqi_avg += (lqi * TX_POWER_AVG_SCALE - state->lqi_avg) / 4;
+
+    return evaluate(state, false);
+}
+
+// Потеря подтверждения сразу поднимает мощность на два шага, серия потерь - до максимума
+bool tx_power_on_tx_result(tx_power_state_t *state, bool acked)
+{
+    if (acked)
+    {
+        state->failures = 0;
+        return false;
+    }
+
+    state->stable_frames = 0;
+    if (state->failures < UINT8_MAX)
+        state->failures++;
+
+    if (state->failures >= TX_POWER_MAX_FAILURES)
+    {
+        return set_power(state, TX_POWER_MAX_DBM);
+    }
+
+    return set_power(state, state->power_dbm + 2 * TX_POWER_STEP_DB);
+}
@@ -0,0 +1,38 @@
+#ifndef APP_TX_POWER_H
+#define APP_TX_POWER_H
+
+#include <stdint.h>
+
+#define TX_POWER_MIN_DBM            -12
+#define TX_POWER_MAX_DBM            20
+#define TX_POWER_STEP_DB            3
+#define TX_POWER_RX_SENSITIVITY_DBM -100
+#define TX_POWER_MARGIN_LOW_DB      12  // Ниже - повышаем мощность
+#define TX_POWER_MARGIN_HIGH_DB     30  // Выше - понижаем, зазор больше шага, чтобы не было качелей
+#define TX_POWER_LQI_LOW            100
+#define TX_POWER_STABLE_FRAMES      8   // Столько кадров с RSSI подряд с запасом перед шагом вниз
+#define TX_POWER_MAX_FAILURES       2   // Столько неподтвержденных кадров подряд - сразу максимум
+#define TX_POWER_AVG_SCALE          16  // Средние хранятся с фиксированной точкой, иначе деление усекает шаг к нулю
+#define TX_POWER_RSSI_UNKNOWN       INT16_MIN
+
+// Состояние регулятора, хранится в RTC-памяти между пробуждениями
+typedef struct
+{
+    int8_t power_dbm;
+    int16_t rssi_avg;       // Сглаженный RSSI кадров от родителя, dBm * TX_POWER_AVG_SCALE
+    uint16_t lqi_avg;       // Сглаженный LQI * TX_POWER_AVG_SCALE, 0 - еще нет данных
+    uint8_t stable_frames;
+    uint8_t failures;
+} tx_power_state_t;
+
+#define TX_POWER_STATE_DEFAULT { TX_POWER_MAX_DBM, TX_POWER_RSSI_UNKNOWN, 0, 0, 0 }
+
+// Функции регулятора не зависят от ESP-IDF и возвращают true, если мощность изменилась
+void tx_power_reset(tx_power_state_t *state);
+bool tx_power_on_rssi(tx_power_state_t *state, int8_t rssi);
+bool tx_power_on_lqi(tx_power_state_t *state, uint8_t lqi);
+bool tx_power_on_tx_result(tx_power_state_t *state, bool acked);
+int8_t tx_power_rssi_dbm(const tx_power_state_t *state);
+uint8_t tx_power_lqi(const tx_power_state_t *state);
+
+#endif
@@ -9,7 +9,11 @@
 #include "esp_log.h"
 #include "ha/esp_zigbee_ha_standard.h"
 #include "nvs_flash.h"
+#include "esp_attr.h"
 #include "app_zigbee.h"
+#include "app_log.h"
+#include "app_poll_control.h"
+#include "app_tx_power.h"
 
 static const char *TAG = "Zigbee";
 
@@ -17,11 +21,50 @@ QueueHandle_t zigbee_event_queue = NULL;
 
 static int8_t retry_count = 1;
 
+// Мощность передатчика подбирается по качеству линка и сохраняется между пробуждениями
+static RTC_DATA_ATTR tx_power_state_t tx_power_state = TX_POWER_STATE_DEFAULT;
+
+// TSN отчетов из update_attribute, ждущих статуса отправки. Мощность подстраивается только
+// по ним: check-in по таблице привязок, например, не уходит, если клиент не привязан.
+static uint32_t pending_report_tsns[256 / 32];
+
 void factory_reset()
 {
     esp_zb_factory_reset();
 }
 
+static void apply_tx_power()
+{
+    esp_zb_set_tx_power(tx_power_state.power_dbm);
+    app_log(APP_LOG_TX_POWER, tx_power_state.power_dbm, tx_power_rssi_dbm(&tx_power_state), tx_power_lqi(&tx_power_state));
+}
+
+// Для конечного устройства все кадры приходят через родителя, LQI отражает линк с ним
+static bool zb_aps_data_indication_handler(esp_zb_apsde_data_ind_t ind)
+{
+    if (tx_power_on_lqi(&tx_power_state, ind.lqi))
+    {
+        apply_tx_power();
+    }
+    return false; // Кадр дальше обрабатывает стек
+}
+
+// Статус отправки ZCL-команд, в расчет идут только отчеты из update_attribute
+static void zb_zcl_send_status_handler(esp_zb_zcl_command_send_status_message_t message)
+{
+    uint32_t bit = 1UL << (message.tsn % 32);
+    if (!(pending_report_tsns[message.tsn / 32] & bit))
+    {
+        return;
+    }
+    pending_report_tsns[message.tsn / 32] &= ~bit;
+
+    if (tx_power_on_tx_result(&tx_power_state, message.status == ESP_OK))
+    {
+        apply_tx_power();
+    }
+}
+
 static void bdb_start_top_level_commissioning_cb(uint8_t mode_mask)
 {
     esp_zb_bdb_start_top_level_commissioning(mode_mask);
@@ -37,7 +80,7 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     switch (sig_type)
     {
         case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
-            ESP_LOGI(TAG, "Initialize Zigbee stack");
+            app_log(APP_LOG_ZB_STACK_INIT);
             esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
             break;
         case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
@@ -48,12 +91,13 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                 {
                     event.type = ZB_EVENT_FACTORY_RESET_MODE;
                     xQueueSend(zigbee_event_queue, &event, portMAX_DELAY);
-                    ESP_LOGI(TAG, "Start network steering");
+                    app_log(APP_LOG_ZB_STEERING_START);
                     esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
                 }
                 else
                 {
-                    ESP_LOGI(TAG, "Device rebooted");
+                    app_log(APP_LOG_ZB_REBOOTED);
+                    apply_tx_power();
                     event.type = ZB_EVENT_REBOOT_SUCCESS;
                     xQueueSend(zigbee_event_queue, &event, portMAX_DELAY);
                 }
@@ -62,11 +106,13 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
             {
                 if (retry_count-- > 0)
                 {
-                    ESP_LOGW(TAG, "%s failed with status: %s. Retrying %d", esp_zb_zdo_signal_to_string(sig_type), esp_err_to_name(err_status), retry_count);
+                    app_log(APP_LOG_ZB_START_FAILED, sig_type, err_status, retry_count);
                     esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb, ESP_ZB_BDB_MODE_INITIALIZATION, 1000);
                 }
                 else
                 {
+                    // Следующее пробуждение начинаем с максимальной мощности
+                    tx_power_reset(&tx_power_state);
                     event.type = ZB_EVENT_CONNECTION_FAILED;
                     xQueueSend(zigbee_event_queue, &event, portMAX_DELAY);
                 }
@@ -77,31 +123,55 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
             {
                 esp_zb_ieee_addr_t extended_pan_id;
                 esp_zb_get_extended_pan_id(extended_pan_id);
-                ESP_LOGI(TAG, "Joined network successfully (Extended PAN ID: %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x, PAN ID: 0x%04hx, Channel:%d, Short Address: 0x%04hx)",
-                        extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4],
-                        extended_pan_id[3], extended_pan_id[2], extended_pan_id[1], extended_pan_id[0],
-                        esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
+                app_log(APP_LOG_ZB_JOINED, esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
+                app_log(APP_LOG_ZB_EXT_PAN_ID,
+                        (uint32_t)extended_pan_id[7] << 24 | extended_pan_id[6] << 16 | extended_pan_id[5] << 8 | extended_pan_id[4],
+                        (uint32_t)extended_pan_id[3] << 24 | extended_pan_id[2] << 16 | extended_pan_id[1] << 8 | extended_pan_id[0]);
+
+                tx_power_reset(&tx_power_state);
+                apply_tx_power();
 
                 event.type = ZB_EVENT_NETWORK_JOINED;
                 xQueueSend(zigbee_event_queue, &event, portMAX_DELAY);
             }
             else
             {
-                ESP_LOGW(TAG, "Network steering was not successful (status: %s). Retrying...", esp_err_to_name(err_status));
+                app_log(APP_LOG_ZB_STEERING_FAILED, err_status);
                 esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb, ESP_ZB_BDB_MODE_NETWORK_STEERING, 1000);
             }
             break;
         case ESP_ZB_COMMON_SIGNAL_CAN_SLEEP:
             break;
         case ESP_ZB_ZDO_SIGNAL_LEAVE_INDICATION:
-            ESP_LOGW(TAG, "Устройство отключено от сети");
+            app_log(APP_LOG_ZB_LEAVE);
             break;
         default:
-            ESP_LOGI(TAG, "ZDO signal: %s (0x%x), status: %s", esp_zb_zdo_signal_to_string(sig_type), sig_type, esp_err_to_name(err_status));
+            app_log(APP_LOG_ZB_SIGNAL, sig_type, err_status);
             break;
     }
 }
 
+static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message)
+{
+    switch (callback_id)
+    {
+        case ESP_ZB_CORE_CMD_CUSTOM_CLUSTER_REQ_CB_ID:
+            return poll_control_handle_command((const esp_zb_zcl_custom_cluster_command_message_t *)message);
+        case ESP_ZB_CORE_CMD_DEFAULT_RESP_CB_ID:
+        {
+            // Default Response на отчет - кадр от координатора с известным RSSI
+            const esp_zb_zcl_cmd_default_resp_message_t *resp = (const esp_zb_zcl_cmd_default_resp_message_t *)message;
+            if (tx_power_on_rssi(&tx_power_state, resp->info.header.rssi))
+            {
+                apply_tx_power();
+            }
+            return ESP_OK;
+        }
+        default:
+            return ESP_OK;
+    }
+}
+
 static esp_zb_cluster_list_t *sensor_clusters_create()
 {
     esp_zb_cluster_list_t *cluster_list = esp_zb_zcl_cluster_list_create();
@@ -169,6 +239,9 @@ static esp_zb_cluster_list_t *sensor_clusters_create()
     ESP_ERROR_CHECK(esp_zb_cluster_add_attr(power_attr_list, ESP_ZB_ZCL_CLUSTER_ID_POWER_CONFIG, ESP_ZB_ZCL_ATTR_POWER_CONFIG_BATTERY_PERCENTAGE_REMAINING_ID, ESP_ZB_ZCL_ATTR_TYPE_U8, ESP_ZB_ZCL_ATTR_ACCESS_REPORTING, &battery_percent_value));
     ESP_ERROR_CHECK(esp_zb_cluster_list_add_power_config_cluster(cluster_list, power_attr_list, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE));
 
+    // ------------------------------- Poll Control -------------------------------
+    ESP_ERROR_CHECK(esp_zb_cluster_list_add_custom_cluster(cluster_list, poll_control_cluster_create(), ESP_ZB_ZCL_CLUSTER_SERVER_ROLE));
+
     return cluster_list;
 }
 
@@ -219,6 +292,9 @@ void zigbee_task(void *pvParameters) {
     ESP_ERROR_CHECK(esp_zb_ep_list_add_ep(ep_list, cluster_list, endpoint_config));
 
     ESP_ERROR_CHECK(esp_zb_device_register(ep_list));
+    esp_zb_core_action_handler_register(zb_action_handler);
+    esp_zb_aps_data_indication_handler_register(zb_aps_data_indication_handler);
+    esp_zb_zcl_command_send_status_handler_register(zb_zcl_send_status_handler);
     ESP_ERROR_CHECK(esp_zb_set_primary_network_channel_set(ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK));
     ESP_ERROR_CHECK(esp_zb_start(true));
     esp_zb_stack_main_loop();
@@ -247,7 +323,8 @@ void update_attribute(uint16_t cluster_id, uint16_t attr_id, void *value_p)
         .attributeID = attr_id
     };
 
-    esp_zb_zcl_report_attr_cmd_req(&report_attr_cmd);
+    uint8_t tsn = esp_zb_zcl_report_attr_cmd_req(&report_attr_cmd);
+    pending_report_tsns[tsn / 32] |= 1UL << (tsn % 32);
     esp_zb_lock_release();
 }
 
@@ -8,7 +8,9 @@
 
 #define INSTALLCODE_POLICY_ENABLE   false
 #define ED_AGING_TIMEOUT            ESP_ZB_ED_AGING_TIMEOUT_64MIN
+#define ED_AGING_TIMEOUT_S          (64 * 60) /* Должен совпадать с ED_AGING_TIMEOUT */
 #define ED_KEEP_ALIVE               3000 /* 1000 millisecond */
+#define SECONDS_TO_SLEEP            120  /* Время сна между пробуждениями */
 #define HA_ESP_SENSOR_ENDPOINT      10 /* esp temperature sensor device endpoint, used for temperature measurement */
 
 typedef enum
@@ -0,0 +1,9 @@
+// Заглушка ESP-IDF для host-тестов: RTC-переменные собираются в отдельную секцию,
+// тест обнуляет ее, моделируя потерю RTC-памяти
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+#define RTC_DATA_ATTR   __attribute__((section("rtc_sim")))
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_sim")))
+
+#endif
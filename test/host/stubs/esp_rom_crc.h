@@ -0,0 +1,9 @@
+// Заглушка ESP-IDF для host-тестов, реализацию дает сам тест
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+#endif
@@ -0,0 +1,240 @@
+// Нагрузочный тест диспетчера измерений: несколько потоков одновременно
+// запрашивают измерения, каждый ожидающий должен получить ровно одно уведомление
+// на запрос, а одновременные запросы - объединяться в одно измерение.
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "app_sampler_core.h"
+#include "test_check.h"
+
+struct fake_task
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t pending = 0;
+    std::atomic<uint32_t> delivered{0};
+};
+
+static thread_local fake_task *current_task = nullptr;
+static fake_task dispatcher_task;
+static std::mutex sample_mutex;
+
+sampler_task_t sampler_port_current_task(void)
+{
+    return current_task;
+}
+
+sampler_task_t sampler_port_dispatcher(void)
+{
+    return &dispatcher_task;
+}
+
+void sampler_port_notify(sampler_task_t task)
+{
+    fake_task *t = (fake_task *)task;
+    t->delivered++;
+    std::lock_guard<std::mutex> lock(t->mutex);
+    t->pending++;
+    t->cv.notify_one();
+}
+
+uint32_t sampler_port_wait(uint32_t timeout_ms)
+{
+    fake_task *t = current_task;
+    std::unique_lock<std::mutex> lock(t->mutex);
+    if (timeout_ms == SAMPLER_WAIT_FOREVER)
+        t->cv.wait(lock, [t] { return t->pending > 0; });
+    else
+        t->cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [t] { return t->pending > 0; });
+
+    uint32_t count = t->pending;
+    t->pending = 0;
+    return count;
+}
+
+void sampler_port_delay_ms(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void sampler_port_lock(void)
+{
+    sample_mutex.lock();
+}
+
+void sampler_port_unlock(void)
+{
+    sample_mutex.unlock();
+}
+
+static std::atomic<int> acquisitions{0};
+static std::atomic<bool> acquiring{false};
+static std::atomic<int> acquire_delay_ms{0};
+
+static void fake_acquire(sensor_sample_t *sample)
+{
+    CHECK(!acquiring.exchange(true)); // Датчики никогда не опрашиваются параллельно
+    int seq = ++acquisitions;
+    std::this_thread::sleep_for(std::chrono::milliseconds(acquire_delay_ms.load()));
+    *sample = {};
+    sample->temperature = (int16_t)seq;
+    acquiring = false;
+}
+
+static std::atomic<bool> stop_dispatcher{false};
+
+static void dispatcher_thread()
+{
+    current_task = &dispatcher_task;
+    while (!stop_dispatcher)
+    {
+        sampler_dispatch(fake_acquire);
+    }
+}
+
+static void stop(std::thread &dispatcher)
+{
+    stop_dispatcher = true;
+    sampler_port_notify(&dispatcher_task);
+    dispatcher.join();
+    stop_dispatcher = false;
+}
+
+// Все ожидающие задачи и "кнопка" без ожидания долбят диспетчер одновременно
+static void test_hammer()
+{
+    const int requests_per_waiter = 25;
+    const int fire_and_forget_requests = 100;
+    fake_task tasks[SAMPLER_MAX_WAITERS];
+    std::atomic<int> successful[SAMPLER_MAX_WAITERS] = {};
+
+    acquisitions = 0;
+    acquire_delay_ms = 2;
+    std::thread dispatcher(dispatcher_thread);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        threads.emplace_back([&, i] {
+            current_task = &tasks[i];
+            for (int r = 0; r < requests_per_waiter; r++)
+            {
+                int before = acquisitions.load();
+                sensor_sample_t sample;
+                CHECK(sampler_request(&sample, 5000));
+                // Результат получен измерением, начатым после запроса
+                CHECK(sample.temperature > before);
+                successful[i]++;
+            }
+        });
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        threads.emplace_back([&] {
+            for (int r = 0; r < fire_and_forget_requests / 2; r++)
+            {
+                CHECK(sampler_request(NULL, 0));
+                std::this_thread::sleep_for(std::chrono::milliseconds(rand() % 20));
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    stop(dispatcher);
+
+    for (int i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        // Ровно одно уведомление на каждый запрос, лишних не осталось
+        CHECK(tasks[i].delivered == (uint32_t)successful[i]);
+        CHECK(tasks[i].pending == 0);
+    }
+
+    int total_requests = SAMPLER_MAX_WAITERS * requests_per_waiter + fire_and_forget_requests;
+    printf("hammer: %d requests -> %d acquisitions\n", total_requests, acquisitions.load());
+    CHECK(acquisitions < total_requests / 2);
+}
+
+// Таймауты короче измерения: отказ через снятие слота или ожидание уже забранного слота
+// не должны терять или дублировать уведомления
+static void test_timeouts()
+{
+    const int requests_per_waiter = 40;
+    fake_task tasks[SAMPLER_MAX_WAITERS];
+    std::atomic<int> successful[SAMPLER_MAX_WAITERS] = {};
+
+    acquire_delay_ms = 5;
+    std::thread dispatcher(dispatcher_thread);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        threads.emplace_back([&, i] {
+            current_task = &tasks[i];
+            for (int r = 0; r < requests_per_waiter; r++)
+            {
+                sensor_sample_t sample;
+                if (sampler_request(&sample, rand() % 60))
+                {
+                    successful[i]++;
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    stop(dispatcher);
+
+    for (int i = 0; i < SAMPLER_MAX_WAITERS; i++)
+    {
+        CHECK(tasks[i].delivered == (uint32_t)successful[i]);
+        CHECK(tasks[i].pending == 0);
+    }
+    printf("timeouts: ok\n");
+}
+
+// Уведомление без запроса - то, что остается после гонки регистрации слота с wait(0)
+// в диспетчере: повторного измерения и отчета быть не должно
+static void test_stale_notification()
+{
+    fake_task task;
+    current_task = &task;
+    acquire_delay_ms = 0;
+    std::thread dispatcher(dispatcher_thread);
+
+    sensor_sample_t sample;
+    CHECK(sampler_request(&sample, 5000));
+    int before = acquisitions.load();
+
+    sampler_port_notify(&dispatcher_task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5 * SAMPLER_COALESCE_WINDOW_MS));
+    CHECK(acquisitions == before);
+
+    CHECK(sampler_request(NULL, 0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5 * SAMPLER_COALESCE_WINDOW_MS));
+    CHECK(acquisitions == before + 1);
+
+    stop(dispatcher);
+    CHECK(acquisitions == before + 1);
+    current_task = nullptr;
+    printf("stale notification: ok\n");
+}
+
+int main()
+{
+    test_hammer();
+    test_timeouts();
+    test_stale_notification();
+    return 0;
+}
@@ -0,0 +1,274 @@
+// Хранилище состояния на смоделированной флеш-памяти: износ секторов за год
+// пробуждений, восстановление после потери RTC-кэша и пропадания питания.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "app_log.h"
+#include "app_sampler_core.h"
+#include "app_store.h"
+#include "test_check.h"
+
+#define FLASH_SIZE              (16 * 1024) // Как раздел app_store в partitions.csv
+#define FLASH_SECTOR_SIZE       4096
+#define FLASH_SECTORS           (FLASH_SIZE / FLASH_SECTOR_SIZE)
+#define RECORDS_PER_SECTOR      170
+#define WAKE_PERIOD_S           120
+#define WAKES_PER_YEAR          (365 * 24 * 3600 / WAKE_PERIOD_S)
+#define CACHE_LOSS_WAKES        997         // Период потери RTC-памяти, не кратен STORE_FLUSH_WAKES
+#define MAX_ERASES_PER_YEAR     40          // Ресурс сектора ~100 тыс. стираний - это >2000 лет
+#define CRASH_SWEEP_OPS         (FLASH_SECTORS * RECORDS_PER_SECTOR + 32) // Полный круг кольца
+#define CRASH_REBOOT_FLUSHES    50          // Холодный старт после сбоя: значение, которое осталось
+                                            // только в RTC-кэше, при нем теряется
+
+// Флеш: запись может только сбрасывать биты, стирание - посекторно в 0xFF
+static uint8_t flash[FLASH_SIZE];
+static uint32_t erase_count[FLASH_SECTORS];
+static uint32_t write_count = 0;
+static const esp_partition_t partition = {FLASH_SIZE};
+
+// Пропадание питания: через столько записей/стираний операция обрывается на середине,
+// дальше флеш недоступна до перезагрузки. -1 - питание не пропадает.
+static long ops_until_crash = -1;
+static bool powered = true;
+static int write_failures = 0;  // Столько следующих записей оборвется без пропадания питания
+
+// RTC-переменные хранилища лежат в этой секции (см. stubs/esp_attr.h)
+extern "C" char __start_rtc_sim[];
+extern "C" char __stop_rtc_sim[];
+
+static bool power_fails()
+{
+    if (!powered)
+    {
+        return true;
+    }
+    if (ops_until_crash >= 0 && ops_until_crash-- == 0)
+    {
+        powered = false;
+        return true;
+    }
+    return false;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char *)
+{
+    return &partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *, size_t src_offset, void *dst, size_t size)
+{
+    if (!powered || src_offset + size > FLASH_SIZE)
+    {
+        return ESP_FAIL;
+    }
+    memcpy(dst, flash + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *, size_t dst_offset, const void *src, size_t size)
+{
+    CHECK(dst_offset + size <= FLASH_SIZE);
+    bool failed = power_fails();
+    if (!failed && write_failures > 0)
+    {
+        write_failures--;
+        failed = true;
+    }
+    if (failed)
+    {
+        size /= 2;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)src;
+    for (size_t i = 0; i < size; i++)
+    {
+        flash[dst_offset + i] &= bytes[i];
+    }
+    write_count++;
+    return failed ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t offset, size_t size)
+{
+    CHECK(offset % FLASH_SECTOR_SIZE == 0 && size == FLASH_SECTOR_SIZE && offset + size <= FLASH_SIZE);
+    bool crash = power_fails();
+    memset(flash + offset, 0xFF, crash ? size / 2 : size);
+    erase_count[offset / FLASH_SECTOR_SIZE]++;
+    return crash ? ESP_FAIL : ESP_OK;
+}
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+void app_log_write(app_log_id_t, const int32_t *, uint8_t)
+{
+}
+
+// Холодный старт: RTC-память потеряна, кэш восстанавливается из флеш
+static void reboot()
+{
+    powered = true;
+    ops_until_crash = -1;
+    memset(__start_rtc_sim, 0, __stop_rtc_sim - __start_rtc_sim);
+    app_store_init();
+}
+
+static void format_flash()
+{
+    memset(flash, 0xFF, sizeof(flash));
+    memset(erase_count, 0, sizeof(erase_count));
+    write_count = 0;
+    reboot();
+}
+
+static uint32_t stored_wake_count()
+{
+    uint32_t wake_count = 0;
+    CHECK(app_store_get(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count)));
+    return wake_count;
+}
+
+static bool stored_sample_equals(const sensor_sample_t *expected)
+{
+    sensor_sample_t sample;
+    return app_store_get(STORE_KEY_LAST_SAMPLE, &sample, sizeof(sample)) && memcmp(&sample, expected, sizeof(sample)) == 0;
+}
+
+// Год пробуждений раз в 2 минуты, как в app_main: счетчик и новое измерение на каждом,
+// запись во флеш раз в STORE_FLUSH_WAKES. Время от времени RTC-память теряется.
+static void test_year_of_wakes()
+{
+    format_flash();
+    uint32_t persisted = 0;
+    for (uint32_t wake = 1; wake <= WAKES_PER_YEAR; wake++)
+    {
+        if (wake % CACHE_LOSS_WAKES == 0)
+        {
+            reboot();
+            CHECK(stored_wake_count() == persisted);
+        }
+        else
+        {
+            app_store_init();
+        }
+
+        uint32_t wake_count = 0;
+        app_store_get(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count));
+        wake_count++;
+        app_store_set(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count));
+
+        sensor_sample_t sample = {(int16_t)(2000 + wake % 500), 4500, 1013, 2950, 80};
+        app_store_set(STORE_KEY_LAST_SAMPLE, &sample, sizeof(sample));
+
+        uint32_t writes = write_count;
+        app_store_flush_if_due(false);
+        if (write_count != writes)
+        {
+            persisted = wake_count;
+        }
+    }
+
+    uint32_t max_erases = 0;
+    for (int sector = 0; sector < FLASH_SECTORS; sector++)
+    {
+        if (erase_count[sector] > max_erases)
+        {
+            max_erases = erase_count[sector];
+        }
+    }
+
+    printf("year: %d wakes, max %u erases per sector\n", WAKES_PER_YEAR, max_erases);
+    CHECK(max_erases <= MAX_ERASES_PER_YEAR);
+
+    reboot();
+    CHECK(stored_wake_count() == persisted);
+}
+
+// Питание пропадает на каждой операции по очереди за полный круг кольца. Измерение
+// не меняется и живет только за счет копирования при сборке мусора: после
+// восстановления кольцо проходит еще два круга с регулярными холодными стартами,
+// и измерение не должно потеряться.
+static void test_power_loss_at_every_operation()
+{
+    const sensor_sample_t sample = {2150, 4500, 1013, 2950, 80};
+    for (long crash_at = 0; crash_at < CRASH_SWEEP_OPS; crash_at++)
+    {
+        format_flash();
+        app_store_set(STORE_KEY_LAST_SAMPLE, &sample, sizeof(sample));
+        app_store_flush_if_due(true);
+
+        ops_until_crash = crash_at;
+        uint32_t wake_count = 0;
+        uint32_t persisted = 0;
+        while (powered)
+        {
+            wake_count++;
+            app_store_set(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count));
+            app_store_flush_if_due(true);
+            if (powered)
+            {
+                persisted = wake_count;
+            }
+        }
+
+        // Оборванная запись могла успеть записаться целиком
+        reboot();
+        CHECK(stored_sample_equals(&sample));
+        uint32_t restored = stored_wake_count();
+        CHECK(restored == persisted || restored == wake_count);
+
+        for (wake_count = restored + 1; wake_count <= restored + 2 * CRASH_SWEEP_OPS; wake_count++)
+        {
+            app_store_set(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count));
+            app_store_flush_if_due(true);
+            if (wake_count % CRASH_REBOOT_FLUSHES == 0)
+            {
+                reboot();
+                CHECK(stored_sample_equals(&sample));
+                CHECK(stored_wake_count() == wake_count);
+            }
+        }
+
+        reboot();
+        CHECK(stored_sample_equals(&sample));
+        CHECK(stored_wake_count() == restored + 2 * CRASH_SWEEP_OPS);
+    }
+}
+
+// Оборванная запись без пропадания питания: следующий сброс кэша не должен
+// программировать тот же слот еще раз поверх наполовину записанных данных
+static void test_failed_write_is_not_reprogrammed()
+{
+    format_flash();
+    for (uint32_t wake_count = 1; wake_count <= 3; wake_count++)
+    {
+        app_store_set(STORE_KEY_WAKE_COUNT, &wake_count, sizeof(wake_count));
+        write_failures = wake_count == 2 ? 1 : 0;
+        app_store_flush_if_due(true);
+    }
+
+    reboot();
+    CHECK(stored_wake_count() == 3);
+}
+
+int main()
+{
+    test_year_of_wakes();
+    test_failed_write_is_not_reprogrammed();
+    test_power_loss_at_every_operation();
+    printf("store: ok\n");
+    return 0;
+}
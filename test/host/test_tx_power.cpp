@@ -0,0 +1,162 @@
+// Регулятор мощности передатчика на смоделированных трассах линка:
+// RSSI/LQI кадров от родителя и подтверждения наших кадров.
+#include <stdio.h>
+#include <stdlib.h>
+#include "app_tx_power.h"
+#include "test_check.h"
+
+// Кадр трассы: RSSI и LQI принятого кадра, подтвержден ли наш кадр
+typedef struct
+{
+    int8_t rssi;
+    uint8_t lqi;
+    bool acked;
+} link_frame_t;
+
+// Проигрывает count одинаковых кадров, возвращает число изменений мощности.
+// Порядок как в app_zigbee: отчет, его статус отправки, затем Default Response
+// от координатора - APS-индикация с LQI и ZCL-команда с RSSI одного кадра.
+static int replay(tx_power_state_t *state, link_frame_t frame, int count)
+{
+    int changes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        changes += tx_power_on_tx_result(state, frame.acked);
+        changes += tx_power_on_lqi(state, frame.lqi);
+        changes += tx_power_on_rssi(state, frame.rssi);
+    }
+    return changes;
+}
+
+static tx_power_state_t fresh_state()
+{
+    tx_power_state_t state = TX_POWER_STATE_DEFAULT;
+    return state;
+}
+
+// Среднее не должно застревать в нескольких единицах от установившегося значения
+static void test_average_converges()
+{
+    tx_power_state_t state = fresh_state();
+    tx_power_on_rssi(&state, -90);
+    for (int i = 0; i < 100; i++)
+    {
+        tx_power_on_rssi(&state, -60);
+    }
+
+    CHECK(tx_power_rssi_dbm(&state) == -60);
+    CHECK(state.power_dbm == 8); // Запас 20 + P <= 30
+}
+
+// Узел рядом с роутером: мощность снижается и держится на минимуме с запасом
+static void test_close_node_settles()
+{
+    tx_power_state_t state = fresh_state();
+    replay(&state, {-45, 250, true}, 100);
+    CHECK(state.power_dbm == -7);
+
+    CHECK(replay(&state, {-45, 250, true}, 500) == 0);
+    CHECK(state.power_dbm == -7);
+}
+
+// Шаг вниз ровно через TX_POWER_STABLE_FRAMES кадров, кадры только с LQI не считаются
+static void test_step_down_frame_count()
+{
+    tx_power_state_t state = fresh_state();
+    CHECK(replay(&state, {-45, 250, true}, TX_POWER_STABLE_FRAMES - 1) == 0);
+    for (int i = 0; i < 100; i++)
+    {
+        CHECK(tx_power_on_lqi(&state, 250) == false);
+    }
+    CHECK(state.power_dbm == TX_POWER_MAX_DBM);
+
+    CHECK(replay(&state, {-45, 250, true}, 1) == 1);
+    CHECK(state.power_dbm == TX_POWER_MAX_DBM - TX_POWER_STEP_DB);
+
+    CHECK(replay(&state, {-45, 250, true}, TX_POWER_STABLE_FRAMES - 1) == 0);
+    CHECK(replay(&state, {-45, 250, true}, 1) == 1);
+}
+
+// Узел на краю сети: мощность не снижается
+static void test_edge_node_stays_high()
+{
+    tx_power_state_t state = fresh_state();
+    CHECK(replay(&state, {-85, 150, true}, 500) == 0);
+    CHECK(state.power_dbm == TX_POWER_MAX_DBM);
+}
+
+// Плохой LQI поднимает мощность даже при хорошем RSSI
+static void test_low_lqi_raises_power()
+{
+    tx_power_state_t state = fresh_state();
+    replay(&state, {-45, 250, true}, 100);
+    CHECK(state.power_dbm == -7);
+
+    replay(&state, {-45, 60, true}, 20);
+    CHECK(state.power_dbm == TX_POWER_MAX_DBM);
+}
+
+// Резкое затухание: мощность быстро поднимается до достаточного запаса,
+// после восстановления линка снова опускается
+static void test_sudden_fade_and_recovery()
+{
+    tx_power_state_t state = fresh_state();
+    replay(&state, {-45, 250, true}, 100);
+    CHECK(state.power_dbm == -7);
+
+    replay(&state, {-80, 200, true}, 20);
+    CHECK(state.power_dbm >= 12 && state.power_dbm <= TX_POWER_MAX_DBM);
+    CHECK(replay(&state, {-80, 200, true}, 200) == 0);
+
+    replay(&state, {-45, 250, true}, 200);
+    CHECK(state.power_dbm == -7);
+}
+
+// Потеря подтверждений: одна - два шага вверх, серия - максимум
+static void test_lost_acks()
+{
+    tx_power_state_t state = fresh_state();
+    replay(&state, {-45, 250, true}, 100);
+    CHECK(state.power_dbm == -7);
+
+    CHECK(tx_power_on_tx_result(&state, false));
+    CHECK(state.power_dbm == -7 + 2 * TX_POWER_STEP_DB);
+
+    CHECK(tx_power_on_tx_result(&state, true) == false);
+    CHECK(tx_power_on_tx_result(&state, false));
+    CHECK(state.power_dbm == -7 + 4 * TX_POWER_STEP_DB);
+
+    CHECK(tx_power_on_tx_result(&state, false));
+    CHECK(state.power_dbm == TX_POWER_MAX_DBM);
+}
+
+// Шумный RSSI около порога не должен раскачивать мощность
+static void test_noise_does_not_oscillate()
+{
+    tx_power_state_t state = fresh_state();
+    srand(1);
+    int changes = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        int8_t rssi = -62 + rand() % 9 - 4;
+        changes += tx_power_on_rssi(&state, rssi);
+        changes += tx_power_on_lqi(&state, 220);
+    }
+
+    printf("noise: %d power changes, settled at %d dBm\n", changes, state.power_dbm);
+    CHECK(changes <= 8);
+}
+
+int main()
+{
+    test_average_converges();
+    test_close_node_settles();
+    test_step_down_frame_count();
+    test_edge_node_stays_high();
+    test_low_lqi_raises_power();
+    test_sudden_fade_and_recovery();
+    test_lost_acks();
+    test_noise_does_not_oscillate();
+    printf("tx power: ok\n");
+    return 0;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Decode the binary RTC log dumped by app_log_dump().
+
+Reads serial output (file or stdin), picks "APPLOG <hex>" lines and prints
+them using the message catalogue from main/app_log.h.
+
+    python tools/app_log_decode.py monitor.txt
+    idf.py monitor | python tools/app_log_decode.py
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+HEADER = os.path.join(os.path.dirname(__file__), '..', 'main', 'app_log.h')
+
+# Must match app_log_record_t: timestamp_ms, wake, id, argc, args[APP_LOG_MAX_ARGS]
+RECORD = struct.Struct('<IHBB4i')
+
+
+def load_catalogue(path):
+    with open(path, encoding='utf-8') as f:
+        text = f.read()
+    entries = re.findall(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', text)
+    # C formats use %ld / %lx for int32_t, Python has no length modifier
+    return [(name, re.sub(r'%([-+ 0#]*\d*)l([dxXu])', r'%\1\2', fmt)) for name, fmt in entries]
+
+
+def decode(line, catalogue):
+    raw = bytes.fromhex(line)
+    timestamp_ms, wake, msg_id, argc, *args = RECORD.unpack(raw[:RECORD.size])
+    if msg_id >= len(catalogue):
+        return f'[wake {wake:5d} {timestamp_ms:8d} ms] <unknown id {msg_id}> {args[:argc]}'
+
+    name, fmt = catalogue[msg_id]
+    # Hex fields are printed as unsigned 32-bit values
+    conversions = re.findall(r'%[-+ 0#]*\d*([dxXu])', fmt)
+    args = [a & 0xFFFFFFFF if conv in 'xX' else a for a, conv in zip(args, conversions)]
+    try:
+        message = fmt % tuple(args)
+    except TypeError:
+        message = f'{fmt} {args}'
+    return f'[wake {wake:5d} {timestamp_ms:8d} ms] {name}: {message}'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', nargs='?', type=argparse.FileType('r', errors='replace'), default=sys.stdin)
+    parser.add_argument('--header', default=HEADER, help='path to app_log.h')
+    options = parser.parse_args()
+
+    catalogue = load_catalogue(options.header)
+    for line in options.input:
+        match = re.search(r'APPLOG ([0-9a-fA-F]+)', line)
+        if match:
+            print(decode(match.group(1), catalogue))
+
+
+if __name__ == '__main__':
+    main()